@@ -1,6 +1,23 @@
 #include "game.hpp"
 #include "assets.hpp"
 
+#include <atomic>
+
+// desktop builds can spread rendering over a pool of threads
+#if !defined(TARGET_32BLIT_HW) && !defined(PICO_BUILD) && !defined(__EMSCRIPTEN__)
+#define BANDED_RENDERER
+
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#endif
+
+#ifdef GOVERNOR_STRESS_TEST
+#include <cstdio>
+#include <cstdlib>
+#endif
+
 #define SCREEN_WIDTH 160
 #define SCREEN_HEIGHT 120
 
@@ -33,6 +50,61 @@
 
 #define POWERUP_FALL_RATE 20
 
+#define MAX_POWERUPS 4
+#define MAX_BLOCKS (LEVEL_WIDTH * LEVEL_HEIGHT)
+
+#define STATE_WORDS (6 + 5 + 3 + MAX_POWERUPS * 3)
+#define STATE_HEALTH_WORD 3
+#define STATE_LEVEL_WORD 11
+#define STATE_POWERUP_COUNT_WORD 13
+
+#define REWIND_BUFFER_SIZE 8192
+#define REWIND_MAX_FRAMES 1024
+#define REWIND_MAX_RECORD (4 + STATE_WORDS * 4 + 1 + MAX_BLOCKS * 2)
+
+#define SUSPEND_SLOT 1
+
+#define STATS_LINES 4
+#define STATS_LINE_HEIGHT 7
+
+#define SFX_CHANNEL 0
+#define SFX_SAMPLE_RATE 22050
+#define SFX_BUFFER_SIZE 64
+#define SFX_WAVETABLE_SIZE 256
+#define SFX_VOICES 4
+#define SFX_QUEUE_SIZE 16
+#define SFX_MERGE_SAMPLES (SFX_SAMPLE_RATE / 50)
+
+#define HIRES_SCALE 2
+
+#define HUD_HEIGHT (SPRITE_SIZE * 3 / 2)
+#define HUD_REFRESH_FRAMES 4
+
+#define FRAME_BUDGET_US 20000
+#define GOVERNOR_OVERRUN_FRAMES 10
+#define GOVERNOR_HEADROOM_FRAMES 120
+#define GOVERNOR_MAX_HEADROOM_FRAMES (GOVERNOR_HEADROOM_FRAMES * 32)
+#define GOVERNOR_HEADROOM_PERCENT 60
+
+#define SFX_REDUCED_VOICES 2
+
+#define STRESS_FRAME_MS 20
+#define STRESS_IDLE_FRAMES 100
+#define STRESS_LOAD_FRAMES 600
+#define STRESS_HEAVY_FRAMES 600
+#define STRESS_RECOVER_FRAMES 1000
+#define STRESS_TAIL_FRAMES 100
+#define STRESS_TAIL_OVERRUNS 5 // scheduling noise allowed once settled
+#define STRESS_UPDATE_US 11000
+#define STRESS_DECORATION_US 6000
+#define STRESS_HUD_US 7000
+#define STRESS_HEAVY_UPDATE_US 10000
+#define STRESS_HEAVY_DECORATION_US 6000
+#define STRESS_HEAVY_HUD_US 14000
+
+#define RENDER_MAX_THREADS 8
+#define RENDER_BENCHMARK_FRAMES 200
+
 using namespace blit;
 
 struct SaveData {
@@ -73,13 +145,99 @@ struct Powerup {
     float xPosition, yPosition;
 };
 
-void render_blocks();
-void render_block(Block);
-void render_powerups();
-void render_powerup(Powerup);
-void render_player();
-void render_hud();
-void render_ball();
+// Everything needed to put a game back exactly where it was.
+// Block positions come from the level layout, so only healths are stored.
+struct GameState {
+    uint32_t words[STATE_WORDS];
+    int8_t blockHealth[MAX_BLOCKS];
+};
+
+struct SuspendData {
+    bool suspended;
+    GameState state;
+};
+
+enum SoundId {
+    SOUND_BLOCK_HIT,
+    SOUND_BLOCK_BREAK,
+    SOUND_BLOCK_SOLID,
+    SOUND_PADDLE,
+    SOUND_POWERUP,
+    SOUND_DEATH,
+    SOUND_COUNT
+};
+
+struct SoundEvent {
+    uint8_t sound;
+    uint8_t pitch;
+};
+
+struct SoundEffect {
+    int16_t* wavetable;
+
+    uint32_t samples;
+    uint32_t step;
+    int32_t sweep;
+
+    uint32_t volume;
+    uint32_t decay;
+};
+
+struct Voice {
+    uint8_t sound;
+
+    uint32_t phase, step;
+    uint32_t volume;
+
+    uint32_t remaining;
+};
+
+struct StressResult {
+    int worstQuality;
+    uint32_t overBudget;
+    uint32_t tailCostUs; // average cost over the last STRESS_TAIL_FRAMES frames
+    uint32_t tailOverBudget;
+    uint32_t raises;
+    uint32_t drops;
+    bool skippedLevel; // quality jumped by more than one level in a single step
+};
+
+// each level keeps everything the previous one dropped
+enum QualityLevel {
+    QUALITY_FULL,
+    QUALITY_NO_DECORATION, // no background image
+    QUALITY_SLOW_HUD, // HUD redrawn every HUD_REFRESH_FRAMES frames
+    QUALITY_FEWER_EFFECTS, // only SFX_REDUCED_VOICES sounds start at once
+    QUALITY_SIMPLE_TITLE, // title drawn as plain text
+    QUALITY_COUNT
+};
+
+void render_blocks(Surface&);
+void render_block(Surface&, Block);
+void render_powerups(Surface&);
+void render_powerup(Surface&, Powerup);
+void render_player(Surface&);
+void render_hud(Surface&);
+void format_stats();
+void render_stats(Surface&);
+void copy_hud_strip(Surface&, bool);
+void render_multiplier(Surface&);
+void render_ball(Surface&);
+void render_title(Surface&);
+void render_frame(Surface&);
+Surface& render_target();
+void upscale_playfield();
+void set_hires(bool);
+void update_game(uint32_t);
+void governor_update(uint32_t);
+void set_quality(int);
+bool quality_applies(int);
+int next_quality(int);
+#ifdef GOVERNOR_STRESS_TEST
+void stress_wait(uint32_t);
+StressResult stress_run(const char*, uint32_t, uint32_t&);
+void governor_stress_test();
+#endif
 void start_game();
 void start_level(int);
 void reset_ball();
@@ -87,6 +245,25 @@ void load_level(int levelLayout[LEVEL_HEIGHT][LEVEL_WIDTH]);
 Block generate_block(int, int, int);
 void handle_block_collisions();
 int blocks_remaining();
+uint32_t next_random();
+void pack_state(GameState&);
+void unpack_state(GameState&);
+void rewind_reset();
+void rewind_capture();
+bool rewind_step();
+void suspend_game();
+void resume_game();
+void sfx_play(uint8_t, uint8_t);
+void sfx_start_voice(uint8_t, uint8_t);
+void sfx_callback(AudioChannel&);
+void sfx_init();
+void sfx_define(uint8_t, int16_t*, float, float, int, uint32_t);
+#ifdef BANDED_RENDERER
+void render_worker(uint32_t, uint32_t);
+void render_set_threads(uint32_t);
+void render_banded();
+void render_benchmark();
+#endif
 
 int state = 0;
 float dt;
@@ -94,6 +271,7 @@ uint32_t lastTime = 0;
 
 
 SaveData saveData;
+SuspendData suspendData;
 
 
 int highscore = 0;
@@ -105,6 +283,99 @@ Ball ball;
 std::vector<Block> blocks;
 std::vector<Powerup> powerups;
 
+uint32_t rngState = 1;
+
+// Rewind history: a ring of variable length records, each one XOR-ed against the frame before it.
+// XOR deltas work in both directions, so the same record takes us forwards or backwards.
+uint8_t rewindBuffer[REWIND_BUFFER_SIZE];
+uint32_t rewindFrames[REWIND_MAX_FRAMES]; // start offset of each record in rewindBuffer
+uint32_t rewindHead = 0; // where the next record gets written
+uint32_t rewindFirst = 0; // index of the oldest record in rewindFrames
+uint32_t rewindCount = 0;
+GameState rewindState; // state as of the newest record
+
+uint32_t rewindCaptureUs = 0; // cost of the last capture
+uint32_t rewindCaptureUsMax = 0;
+
+bool showStats = false;
+std::string statsLines[STATS_LINES];
+
+int16_t sineTable[SFX_WAVETABLE_SIZE];
+int16_t squareTable[SFX_WAVETABLE_SIZE];
+int16_t triangleTable[SFX_WAVETABLE_SIZE];
+int16_t noiseTable[SFX_WAVETABLE_SIZE];
+
+SoundEffect soundEffects[SOUND_COUNT];
+Voice voices[SFX_VOICES];
+
+// events from the game loop, handed over to the audio callback without locking
+SoundEvent sfxQueue[SFX_QUEUE_SIZE];
+std::atomic<uint32_t> sfxQueueHead(0);
+std::atomic<uint32_t> sfxQueueTail(0);
+
+// written by the audio callback, which is a separate thread on desktop
+std::atomic<uint32_t> sfxMixUs(0); // cost of mixing the last buffer
+std::atomic<uint32_t> sfxMixUsMax(0);
+#ifdef TARGET_32BLIT_HW
+std::atomic<uint32_t> sfxMixTotalUs(0); // mixing time since the governor last looked
+#endif
+
+// in hires the game is still laid out at SCREEN_WIDTH x SCREEN_HEIGHT, drawn here and then scaled up
+bool hires = false;
+uint8_t playfieldData[SCREEN_WIDTH * SCREEN_HEIGHT * 3];
+Surface playfield(playfieldData, PixelFormat::RGB, Size(SCREEN_WIDTH, SCREEN_HEIGHT));
+
+uint32_t upscaleUs = 0; // cost of the last upscale
+
+// frame budget governor, steps quality down under sustained overrun and back up with headroom
+int quality = QUALITY_FULL;
+uint32_t frameUpdateUs = 0; // update() time since the last render
+uint32_t frameCostUs = 0; // update() and render() time of the last frame
+uint32_t overrunFrames = 0;
+uint32_t headroomFrames = 0;
+uint32_t headroomTarget = GOVERNOR_HEADROOM_FRAMES; // frames of headroom needed before stepping up
+uint32_t qualityFrames = 0; // frames since the last change
+bool qualityRaised = false; // whether the last change was a step up
+uint32_t qualityTimeMs[QUALITY_COUNT] = {};
+uint32_t qualityChanges = 0;
+uint32_t lastGovernorTime = 0;
+
+std::atomic<uint32_t> sfxVoiceLimit(SFX_VOICES);
+
+uint8_t hudCache[SCREEN_WIDTH * HUD_HEIGHT * 4];
+uint32_t hudFrame = 0;
+bool hudCached = false;
+
+#ifdef GOVERNOR_STRESS_TEST
+// artificial load, busy waited where the real work would be
+uint32_t stressUpdateUs = 0;
+uint32_t stressDecorationUs = 0;
+uint32_t stressHudUs = 0;
+#endif
+
+#ifdef BANDED_RENDERER
+// one clipped surface per horizontal band of the framebuffer, band 0 is drawn by the render thread
+std::vector<Surface*> renderBands;
+std::vector<std::thread> renderWorkers;
+
+std::mutex renderMutex;
+std::condition_variable renderStart;
+std::condition_variable renderDone;
+
+uint32_t renderGeneration = 0;
+uint32_t renderPending = 0;
+bool renderQuit = false;
+
+bool renderBenchmarkRequested = false;
+
+// joins the workers on exit, otherwise std::thread terminates the program
+struct RenderWorkersGuard {
+    ~RenderWorkersGuard() {
+        render_set_threads(1);
+    }
+} renderWorkersGuard;
+#endif
+
 Surface* background = Surface::load(asset_background);
 
 uint8_t title[TITLE_WORDS][TITLE_HEIGHT][TITLE_WIDTH] = {
@@ -291,13 +562,13 @@ float clamp(float x, float mi, float ma) {
     return min(max(x, mi), ma);
 }
 
-void render_blocks() {
+void render_blocks(Surface& surface) {
     for (int i = 0; i < blocks.size(); i++) {
-        render_block(blocks.at(i));
+        render_block(surface, blocks.at(i));
     }
 }
 
-void render_block(Block block) {
+void render_block(Surface& surface, Block block) {
     int index = block.health - 1;
     if (block.noValue) {
         index = 10 - block.health;
@@ -306,94 +577,120 @@ void render_block(Block block) {
         index = 6;
     }
     if (block.health != 0) {
-        screen.sprite(index * 2, Point(block.xPosition, block.yPosition));
-        screen.sprite(index * 2 + 1, Point(block.xPosition + SPRITE_SIZE, block.yPosition));
+        surface.sprite(index * 2, Point(block.xPosition, block.yPosition));
+        surface.sprite(index * 2 + 1, Point(block.xPosition + SPRITE_SIZE, block.yPosition));
     }
 }
 
-void render_powerups() {
+void render_powerups(Surface& surface) {
     for (int i = 0; i < powerups.size(); i++) {
-        render_powerup(powerups.at(i));
+        render_powerup(surface, powerups.at(i));
     }
 }
 
-void render_powerup(Powerup powerup) {
+void render_powerup(Surface& surface, Powerup powerup) {
     if (powerup.id == 0) {
-        screen.blit(screen.sprites, Rect(8, 16, 24, 4), Point(powerup.xPosition - 12, powerup.yPosition - 2));
+        surface.blit(surface.sprites, Rect(8, 16, 24, 4), Point(powerup.xPosition - 12, powerup.yPosition - 2));
     }
     else if (powerup.id == 1) {
-        screen.blit(screen.sprites, Rect(32, 16, 16, 4), Point(powerup.xPosition - 8, powerup.yPosition - 2));
+        surface.blit(surface.sprites, Rect(32, 16, 16, 4), Point(powerup.xPosition - 8, powerup.yPosition - 2));
     }
     else if (powerup.id == 2) {
-        screen.sprite(47, Point(powerup.xPosition - 4, powerup.yPosition - 4));
+        surface.sprite(47, Point(powerup.xPosition - 4, powerup.yPosition - 4));
     }
 }
 
-void render_player() {
+void render_player(Surface& surface) {
     int left = player.xPosition - player.width;
 
-    screen.blit(screen.sprites, Rect(4, 16, 1, 4), Point(left, player.yPosition));
+    surface.blit(surface.sprites, Rect(4, 16, 1, 4), Point(left, player.yPosition));
 
     for (int i = 0; i < player.width - 1; i++) {
-        screen.blit(screen.sprites, Rect(5, 16, 2, 4), Point(left + 1 + i * 2, player.yPosition));
+        surface.blit(surface.sprites, Rect(5, 16, 2, 4), Point(left + 1 + i * 2, player.yPosition));
     }
 
-    screen.blit(screen.sprites, Rect(7, 16, 1, 4), Point(left + player.width * 2 - 1, player.yPosition));
+    surface.blit(surface.sprites, Rect(7, 16, 1, 4), Point(left + player.width * 2 - 1, player.yPosition));
 }
 
-void render_hud() {
+void render_hud(Surface& surface) {
     // SCORE
-    screen.blit(screen.sprites, Rect(48, 24, 24, 8), Point(BORDER, BORDER));
+    surface.blit(surface.sprites, Rect(48, 24, 24, 8), Point(BORDER, BORDER));
 
     // :
-    screen.blit(screen.sprites, Rect(72, 24, 2, 8), Point(BORDER + SPRITE_SIZE * 3 + 1, BORDER));
+    surface.blit(surface.sprites, Rect(72, 24, 2, 8), Point(BORDER + SPRITE_SIZE * 3 + 1, BORDER));
 
     // <score>
-    screen.blit(screen.sprites, Rect(4 * (int)((player.score % 100000) / 10000), 24, 4, 8), Point(BORDER + SPRITE_SIZE * 3 + 4, BORDER));
-    screen.blit(screen.sprites, Rect(4 * (int)((player.score % 10000) / 1000), 24, 4, 8), Point(BORDER + SPRITE_SIZE * 3 + 9, BORDER));
-    screen.blit(screen.sprites, Rect(4 * (int)((player.score % 1000) / 100), 24, 4, 8), Point(BORDER + SPRITE_SIZE * 3 + 14, BORDER));
-    screen.blit(screen.sprites, Rect(4 * (int)((player.score % 100) / 10), 24, 4, 8), Point(BORDER + SPRITE_SIZE * 3 + 19, BORDER));
-    screen.blit(screen.sprites, Rect(4 * (int)((player.score % 10)), 24, 4, 8), Point(BORDER + SPRITE_SIZE * 3 + 24, BORDER));
+    surface.blit(surface.sprites, Rect(4 * (int)((player.score % 100000) / 10000), 24, 4, 8), Point(BORDER + SPRITE_SIZE * 3 + 4, BORDER));
+    surface.blit(surface.sprites, Rect(4 * (int)((player.score % 10000) / 1000), 24, 4, 8), Point(BORDER + SPRITE_SIZE * 3 + 9, BORDER));
+    surface.blit(surface.sprites, Rect(4 * (int)((player.score % 1000) / 100), 24, 4, 8), Point(BORDER + SPRITE_SIZE * 3 + 14, BORDER));
+    surface.blit(surface.sprites, Rect(4 * (int)((player.score % 100) / 10), 24, 4, 8), Point(BORDER + SPRITE_SIZE * 3 + 19, BORDER));
+    surface.blit(surface.sprites, Rect(4 * (int)((player.score % 10)), 24, 4, 8), Point(BORDER + SPRITE_SIZE * 3 + 24, BORDER));
 
 
     // HI
-    screen.blit(screen.sprites, Rect(40, 24, 8, 8), Point(SCREEN_WIDTH - BORDER - 28 - SPRITE_SIZE, BORDER));
+    surface.blit(surface.sprites, Rect(40, 24, 8, 8), Point(SCREEN_WIDTH - BORDER - 28 - SPRITE_SIZE, BORDER));
 
     // :
-    screen.blit(screen.sprites, Rect(72, 24, 2, 8), Point(SCREEN_WIDTH - BORDER - 27, BORDER));
+    surface.blit(surface.sprites, Rect(72, 24, 2, 8), Point(SCREEN_WIDTH - BORDER - 27, BORDER));
 
     // <highscore>
-    screen.blit(screen.sprites, Rect(4 * (int)((highscore % 100000) / 10000), 24, 4, 8), Point(SCREEN_WIDTH - BORDER - 24, BORDER));
-    screen.blit(screen.sprites, Rect(4 * (int)((highscore % 10000) / 1000), 24, 4, 8), Point(SCREEN_WIDTH - BORDER - 19, BORDER));
-    screen.blit(screen.sprites, Rect(4 * (int)((highscore % 1000) / 100), 24, 4, 8), Point(SCREEN_WIDTH - BORDER - 14, BORDER));
-    screen.blit(screen.sprites, Rect(4 * (int)((highscore % 100) / 10), 24, 4, 8), Point(SCREEN_WIDTH - BORDER - 9, BORDER));
-    screen.blit(screen.sprites, Rect(4 * (int)((highscore % 10)), 24, 4, 8), Point(SCREEN_WIDTH - BORDER - 4, BORDER));
+    surface.blit(surface.sprites, Rect(4 * (int)((highscore % 100000) / 10000), 24, 4, 8), Point(SCREEN_WIDTH - BORDER - 24, BORDER));
+    surface.blit(surface.sprites, Rect(4 * (int)((highscore % 10000) / 1000), 24, 4, 8), Point(SCREEN_WIDTH - BORDER - 19, BORDER));
+    surface.blit(surface.sprites, Rect(4 * (int)((highscore % 1000) / 100), 24, 4, 8), Point(SCREEN_WIDTH - BORDER - 14, BORDER));
+    surface.blit(surface.sprites, Rect(4 * (int)((highscore % 100) / 10), 24, 4, 8), Point(SCREEN_WIDTH - BORDER - 9, BORDER));
+    surface.blit(surface.sprites, Rect(4 * (int)((highscore % 10)), 24, 4, 8), Point(SCREEN_WIDTH - BORDER - 4, BORDER));
 
     // Health
     for (int i = 0; i < player.health; i++) {
-        screen.sprite(47, Point(SCREEN_WIDTH / 2 + (SPRITE_SIZE * (i - 2.5)), BORDER));
-        //screen.blit(screen.sprites, Rect(112, 16, 16, 4), Point(SCREEN_WIDTH / 2 + (SPRITE_SIZE * (i - 1.5)), BORDER));
+        surface.sprite(47, Point(SCREEN_WIDTH / 2 + (SPRITE_SIZE * (i - 2.5)), BORDER));
+        //surface.blit(surface.sprites, Rect(112, 16, 16, 4), Point(SCREEN_WIDTH / 2 + (SPRITE_SIZE * (i - 1.5)), BORDER));
     }
 
     // Level
-    screen.blit(screen.sprites, Rect(80, 24, 16, 8), Point(SCREEN_WIDTH / 2 + 10, BORDER));
+    surface.blit(surface.sprites, Rect(80, 24, 16, 8), Point(SCREEN_WIDTH / 2 + 10, BORDER));
 
     // :
-    screen.blit(screen.sprites, Rect(72, 24, 2, 8), Point(SCREEN_WIDTH / 2 + 25, BORDER));
+    surface.blit(surface.sprites, Rect(72, 24, 2, 8), Point(SCREEN_WIDTH / 2 + 25, BORDER));
 
     // <levelnumber>
-    screen.blit(screen.sprites, Rect(4 * (levelNumber + 1), 24, 4, 8), Point(SCREEN_WIDTH / 2 + 28, BORDER));
+    surface.blit(surface.sprites, Rect(4 * (levelNumber + 1), 24, 4, 8), Point(SCREEN_WIDTH / 2 + 28, BORDER));
+}
 
+void render_multiplier(Surface& surface) {
     int multiplier = 1 + (player.combo / 2);
 
     if (multiplier > 1) {
         // multiplier
-        screen.text("x" + std::to_string(multiplier), minimal_font, Point(BORDER * 4, BORDER * 8), true, TextAlign::center_center);
+        surface.text("x" + std::to_string(multiplier), minimal_font, Point(BORDER * 4, BORDER * 8), true, TextAlign::center_center);
+    }
+}
+
+void format_stats() {
+    // read every counter once per frame, so all bands draw the same numbers
+    statsLines[0] = "rewind " + std::to_string(rewindCaptureUs) + "/" + std::to_string(rewindCaptureUsMax) + "us " + std::to_string(rewindCount) + "f";
+    statsLines[1] = "mix " + std::to_string(sfxMixUs.load(std::memory_order_relaxed)) + "/" + std::to_string(sfxMixUsMax.load(std::memory_order_relaxed)) + "us";
+    statsLines[2] = "frame " + std::to_string(frameCostUs) + "us q" + std::to_string(quality) + " x" + std::to_string(qualityChanges);
+
+    // only meaningful while the playfield is being upscaled
+    if (hires) {
+        statsLines[2] += " up " + std::to_string(upscaleUs) + "us";
+    }
+
+    // seconds spent at each quality level
+    statsLines[3] = "s";
+    for (int i = 0; i < QUALITY_COUNT; i++) {
+        statsLines[3] += " " + std::to_string(qualityTimeMs[i] / 1000);
     }
 }
 
-void render_ball() {
-    screen.blit(screen.sprites, Rect(0, 16, 4, 4), Point(ball.xPosition, ball.yPosition));
+void render_stats(Surface& surface) {
+    for (int i = 0; i < STATS_LINES; i++) {
+        surface.text(statsLines[i], minimal_font, Point(BORDER, SCREEN_HEIGHT / 2 + i * STATS_LINE_HEIGHT));
+    }
+}
+
+void render_ball(Surface& surface) {
+    surface.blit(surface.sprites, Rect(0, 16, 4, 4), Point(ball.xPosition, ball.yPosition));
 }
 
 void start_game() {
@@ -411,6 +708,9 @@ void start_level(int levelNum) {
     load_level(levelLayouts[levelNumber]);
 
     reset_ball();
+
+    // history doesn't carry over between levels
+    rewind_reset();
 }
 
 void reset_ball() {
@@ -460,7 +760,7 @@ Block generate_block(int health, int x, int y) {
 Powerup get_powerup(int x, int y) {
     Powerup powerup;
 
-    powerup.id = idWeights[rand() % ID_WEIGHT_LENGTH];
+    powerup.id = idWeights[next_random() % ID_WEIGHT_LENGTH];
 
     powerup.xPosition = x;
     powerup.yPosition = y;
@@ -492,6 +792,17 @@ void handle_block_collisions() {
                             blocks.at(i).health -= 1;
                         }
 
+                        if (blocks.at(i).health == -1) {
+                            sfx_play(SOUND_BLOCK_SOLID, 0);
+                        }
+                        else if (blocks.at(i).health == 0) {
+                            sfx_play(SOUND_BLOCK_BREAK, 0);
+                        }
+                        else {
+                            // tougher blocks ring a little higher
+                            sfx_play(SOUND_BLOCK_HIT, blocks.at(i).health);
+                        }
+
                         while (colliding(blocks.at(i))) {
                             ball.xPosition -= ball.xVelocity;
                             ball.yPosition -= ball.yVelocity;
@@ -529,9 +840,15 @@ void handle_block_collisions() {
                             // increase combo after adjusting score
                             player.combo += 1;
 
-                            if (blocks.at(i).health == 0 && rand() % POWERUP_CHANCE == 0) {
+                            if (blocks.at(i).health == 0 && next_random() % POWERUP_CHANCE == 0) {
                                 // create powerup
-                                powerups.push_back(get_powerup(blocks.at(i).xPosition + SPRITE_SIZE, blocks.at(i).yPosition + SPRITE_SIZE / 2));
+                                Powerup powerup = get_powerup(blocks.at(i).xPosition + SPRITE_SIZE, blocks.at(i).yPosition + SPRITE_SIZE / 2);
+
+                                // the saved state only has room for MAX_POWERUPS, any more are dropped
+                                // (after the rolls, so the random sequence doesn't change)
+                                if (powerups.size() < MAX_POWERUPS) {
+                                    powerups.push_back(powerup);
+                                }
                             }
                         }
                     }
@@ -551,7 +868,407 @@ int blocks_remaining() {
     return total;
 }
 
-void render_title() {
+uint32_t next_random() {
+    // xorshift32, kept in rngState so it can be saved and rewound with the rest of the game
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 17;
+    rngState ^= rngState << 5;
+    return rngState;
+}
+
+uint32_t float_bits(float f) {
+    uint32_t u;
+    memcpy(&u, &f, sizeof(u));
+    return u;
+}
+
+float bits_float(uint32_t u) {
+    float f;
+    memcpy(&f, &u, sizeof(f));
+    return f;
+}
+
+void pack_state(GameState& gameState) {
+    uint32_t* w = gameState.words;
+
+    *w++ = float_bits(player.xPosition);
+    *w++ = float_bits(player.yPosition);
+    *w++ = player.width;
+    *w++ = player.health;
+    *w++ = player.score;
+    *w++ = player.combo;
+
+    *w++ = float_bits(ball.xPosition);
+    *w++ = float_bits(ball.yPosition);
+    *w++ = float_bits(ball.xVelocity);
+    *w++ = float_bits(ball.yVelocity);
+    *w++ = ball.held;
+
+    *w++ = levelNumber;
+    *w++ = rngState;
+    *w++ = powerups.size();
+
+    for (uint32_t i = 0; i < MAX_POWERUPS; i++) {
+        if (i < powerups.size()) {
+            *w++ = powerups.at(i).id;
+            *w++ = float_bits(powerups.at(i).xPosition);
+            *w++ = float_bits(powerups.at(i).yPosition);
+        }
+        else {
+            // keep unused slots zero so they never show up in a delta
+            *w++ = 0;
+            *w++ = 0;
+            *w++ = 0;
+        }
+    }
+
+    for (uint32_t i = 0; i < MAX_BLOCKS; i++) {
+        gameState.blockHealth[i] = i < blocks.size() ? blocks.at(i).health : 0;
+    }
+}
+
+void unpack_state(GameState& gameState) {
+    uint32_t* w = gameState.words;
+
+    player.xPosition = bits_float(*w++);
+    player.yPosition = bits_float(*w++);
+    player.width = *w++;
+    player.health = *w++;
+    player.score = *w++;
+    player.combo = *w++;
+
+    ball.xPosition = bits_float(*w++);
+    ball.yPosition = bits_float(*w++);
+    ball.xVelocity = bits_float(*w++);
+    ball.yVelocity = bits_float(*w++);
+    ball.held = *w++;
+
+    levelNumber = *w++;
+    rngState = *w++;
+    uint32_t powerupCount = *w++;
+
+    powerups.clear();
+
+    for (uint32_t i = 0; i < MAX_POWERUPS; i++) {
+        Powerup powerup;
+        powerup.id = *w++;
+        powerup.xPosition = bits_float(*w++);
+        powerup.yPosition = bits_float(*w++);
+
+        if (i < powerupCount) {
+            powerups.push_back(powerup);
+        }
+    }
+
+    for (uint32_t i = 0; i < blocks.size(); i++) {
+        blocks.at(i).health = gameState.blockHealth[i];
+    }
+}
+
+void rewind_reset() {
+    rewindHead = 0;
+    rewindFirst = 0;
+    rewindCount = 0;
+
+    // the first record is a delta against all zeroes, which makes it a full keyframe
+    memset(&rewindState, 0, sizeof(rewindState));
+}
+
+void rewind_capture() {
+    uint32_t start = now_us();
+
+    GameState current;
+    pack_state(current);
+
+    // encode the record: changed word mask, changed words, then changed block healths
+    uint8_t record[REWIND_MAX_RECORD];
+    uint32_t length = 4;
+    uint32_t mask = 0;
+
+    for (int i = 0; i < STATE_WORDS; i++) {
+        uint32_t delta = current.words[i] ^ rewindState.words[i];
+
+        if (delta) {
+            mask |= 1 << i;
+            memcpy(&record[length], &delta, 4);
+            length += 4;
+        }
+    }
+
+    memcpy(&record[0], &mask, 4);
+
+    // only a handful of blocks get hit each frame, so store those as index/delta pairs
+    uint32_t countIndex = length++;
+    uint8_t blockCount = 0;
+
+    for (int i = 0; i < MAX_BLOCKS; i++) {
+        uint8_t delta = current.blockHealth[i] ^ rewindState.blockHealth[i];
+
+        if (delta) {
+            record[length++] = i;
+            record[length++] = delta;
+            blockCount++;
+        }
+    }
+
+    record[countIndex] = blockCount;
+
+    // drop the oldest frames until the new record fits
+    while (rewindCount > 0 && (rewindCount == REWIND_MAX_FRAMES || rewindHead - rewindFrames[rewindFirst] + length > REWIND_BUFFER_SIZE)) {
+        rewindFirst = (rewindFirst + 1) % REWIND_MAX_FRAMES;
+        rewindCount--;
+    }
+
+    for (uint32_t i = 0; i < length; i++) {
+        rewindBuffer[(rewindHead + i) % REWIND_BUFFER_SIZE] = record[i];
+    }
+
+    rewindFrames[(rewindFirst + rewindCount) % REWIND_MAX_FRAMES] = rewindHead;
+    rewindCount++;
+    rewindHead += length;
+
+    rewindState = current;
+
+    rewindCaptureUs = us_diff(start, now_us());
+    if (rewindCaptureUs > rewindCaptureUsMax) {
+        rewindCaptureUsMax = rewindCaptureUs;
+    }
+}
+
+bool rewind_step() {
+    // the oldest record's delta points at a frame which has already been dropped
+    if (rewindCount < 2) {
+        return false;
+    }
+
+    rewindCount--;
+    uint32_t offset = rewindFrames[(rewindFirst + rewindCount) % REWIND_MAX_FRAMES];
+    rewindHead = offset;
+
+    uint32_t mask = 0;
+    for (int i = 0; i < 4; i++) {
+        mask |= rewindBuffer[offset++ % REWIND_BUFFER_SIZE] << (i * 8);
+    }
+
+    for (int i = 0; i < STATE_WORDS; i++) {
+        if (mask & (1 << i)) {
+            uint32_t delta = 0;
+            for (int j = 0; j < 4; j++) {
+                delta |= rewindBuffer[offset++ % REWIND_BUFFER_SIZE] << (j * 8);
+            }
+
+            rewindState.words[i] ^= delta;
+        }
+    }
+
+    uint8_t blockCount = rewindBuffer[offset++ % REWIND_BUFFER_SIZE];
+
+    for (int i = 0; i < blockCount; i++) {
+        uint8_t index = rewindBuffer[offset++ % REWIND_BUFFER_SIZE];
+        rewindState.blockHealth[index] ^= rewindBuffer[offset++ % REWIND_BUFFER_SIZE];
+    }
+
+    unpack_state(rewindState);
+
+    return true;
+}
+
+void suspend_game() {
+    suspendData.suspended = true;
+    pack_state(suspendData.state);
+    write_save(suspendData, SUSPEND_SLOT);
+}
+
+void resume_game() {
+    // a suspended game can only be resumed once
+    suspendData.suspended = false;
+    write_save(suspendData, SUSPEND_SLOT);
+
+    uint32_t level = suspendData.state.words[STATE_LEVEL_WORD];
+    int health = suspendData.state.words[STATE_HEALTH_WORD];
+    uint32_t powerupCount = suspendData.state.words[STATE_POWERUP_COUNT_WORD];
+
+    if (level >= LEVEL_COUNT || health <= 0 || powerupCount > MAX_POWERUPS) {
+        // stale or corrupt save, start over instead
+        start_game();
+        return;
+    }
+
+    // blocks are rebuilt from the layout before their healths are restored
+    levelNumber = level;
+    load_level(levelLayouts[levelNumber]);
+    unpack_state(suspendData.state);
+
+    rewind_reset();
+}
+
+void sfx_play(uint8_t sound, uint8_t pitch) {
+    // single producer (the game loop), single consumer (the audio callback)
+    uint32_t head = sfxQueueHead.load(std::memory_order_relaxed);
+
+    if (head - sfxQueueTail.load(std::memory_order_acquire) == SFX_QUEUE_SIZE) {
+        // full, the mixer is already busy enough
+        return;
+    }
+
+    sfxQueue[head % SFX_QUEUE_SIZE].sound = sound;
+    sfxQueue[head % SFX_QUEUE_SIZE].pitch = pitch;
+
+    sfxQueueHead.store(head + 1, std::memory_order_release);
+}
+
+void sfx_start_voice(uint8_t sound, uint8_t pitch) {
+    SoundEffect& effect = soundEffects[sound];
+
+    // voices past the limit are left to finish, but nothing new starts on them
+    int limit = sfxVoiceLimit.load(std::memory_order_relaxed);
+
+    int index = -1;
+
+    for (int i = 0; i < limit; i++) {
+        if (voices[i].remaining > 0 && voices[i].sound == sound && effect.samples - voices[i].remaining < SFX_MERGE_SAMPLES) {
+            // same sound started moments ago, retrigger it rather than stacking another copy
+            index = i;
+            break;
+        }
+    }
+
+    if (index == -1) {
+        for (int i = 0; i < limit; i++) {
+            if (voices[i].remaining == 0) {
+                index = i;
+                break;
+            }
+        }
+    }
+
+    if (index == -1) {
+        // no free voice, steal the quietest one
+        index = 0;
+
+        for (int i = 1; i < limit; i++) {
+            if (voices[i].volume < voices[index].volume) {
+                index = i;
+            }
+        }
+    }
+
+    Voice& voice = voices[index];
+
+    voice.sound = sound;
+    voice.phase = 0;
+    voice.step = effect.step + (effect.step >> 3) * pitch;
+    voice.volume = effect.volume;
+    voice.remaining = effect.samples;
+}
+
+void sfx_callback(AudioChannel& channel) {
+    uint32_t start = now_us();
+
+    // pick up everything queued since the last buffer, merging repeats of the same sound
+    uint32_t tail = sfxQueueTail.load(std::memory_order_relaxed);
+    uint32_t head = sfxQueueHead.load(std::memory_order_acquire);
+
+    uint32_t started = 0;
+
+    while (tail != head) {
+        SoundEvent event = sfxQueue[tail % SFX_QUEUE_SIZE];
+        tail++;
+
+        if (!(started & (1 << event.sound))) {
+            started |= 1 << event.sound;
+            sfx_start_voice(event.sound, event.pitch);
+        }
+    }
+
+    sfxQueueTail.store(tail, std::memory_order_release);
+
+    int32_t mix[SFX_BUFFER_SIZE] = {};
+
+    for (int i = 0; i < SFX_VOICES; i++) {
+        Voice& voice = voices[i];
+
+        if (voice.remaining == 0) {
+            continue;
+        }
+
+        SoundEffect& effect = soundEffects[voice.sound];
+
+        uint32_t count = voice.remaining < SFX_BUFFER_SIZE ? voice.remaining : SFX_BUFFER_SIZE;
+
+        for (uint32_t j = 0; j < count; j++) {
+            mix[j] += (effect.wavetable[voice.phase >> 24] * (int32_t)voice.volume) >> 16;
+
+            voice.phase += voice.step;
+            voice.step += effect.sweep;
+            voice.volume -= effect.decay;
+        }
+
+        voice.remaining -= count;
+    }
+
+    for (int i = 0; i < SFX_BUFFER_SIZE; i++) {
+        channel.wave_buffer[i] = mix[i] > INT16_MAX ? INT16_MAX : mix[i] < INT16_MIN ? INT16_MIN : mix[i];
+    }
+
+    uint32_t mixUs = us_diff(start, now_us());
+    sfxMixUs.store(mixUs, std::memory_order_relaxed);
+#ifdef TARGET_32BLIT_HW
+    sfxMixTotalUs.fetch_add(mixUs, std::memory_order_relaxed);
+#endif
+
+    // only this callback writes it, so a plain compare and store is enough
+    if (mixUs > sfxMixUsMax.load(std::memory_order_relaxed)) {
+        sfxMixUsMax.store(mixUs, std::memory_order_relaxed);
+    }
+}
+
+void sfx_init() {
+    // build the wavetables up front, the audio callback only ever reads them
+    uint32_t noise = 0x2545f491;
+
+    for (int i = 0; i < SFX_WAVETABLE_SIZE; i++) {
+        sineTable[i] = sinf(i * 2 * pi / SFX_WAVETABLE_SIZE) * INT16_MAX;
+        squareTable[i] = i < SFX_WAVETABLE_SIZE / 2 ? INT16_MAX / 2 : -INT16_MAX / 2;
+        triangleTable[i] = i < SFX_WAVETABLE_SIZE / 2 ? -INT16_MAX + i * 4 * INT16_MAX / SFX_WAVETABLE_SIZE : 3 * INT16_MAX - i * 4 * INT16_MAX / SFX_WAVETABLE_SIZE;
+
+        noise ^= noise << 13;
+        noise ^= noise >> 17;
+        noise ^= noise << 5;
+        noiseTable[i] = (int16_t)(noise >> 16) / 2;
+    }
+
+    // wavetable, start frequency, end frequency, length in ms, volume
+    sfx_define(SOUND_BLOCK_HIT, squareTable, 660, 880, 40, 0x4000);
+    sfx_define(SOUND_BLOCK_BREAK, squareTable, 880, 1320, 70, 0x4000);
+    sfx_define(SOUND_BLOCK_SOLID, triangleTable, 220, 200, 50, 0x6000);
+    sfx_define(SOUND_PADDLE, triangleTable, 440, 440, 50, 0x6000);
+    sfx_define(SOUND_POWERUP, sineTable, 520, 1560, 180, 0x6000);
+    sfx_define(SOUND_DEATH, noiseTable, 1200, 150, 400, 0x8000);
+
+    channels[SFX_CHANNEL].waveforms = Waveform::WAVE;
+    channels[SFX_CHANNEL].wave_buffer_callback = &sfx_callback;
+    channels[SFX_CHANNEL].volume = 0xffff;
+    channels[SFX_CHANNEL].attack_ms = 1;
+    channels[SFX_CHANNEL].decay_ms = 1;
+    channels[SFX_CHANNEL].sustain = 0xffff;
+    channels[SFX_CHANNEL].release_ms = 1;
+    channels[SFX_CHANNEL].trigger_attack();
+}
+
+void sfx_define(uint8_t sound, int16_t* wavetable, float startFrequency, float endFrequency, int lengthMs, uint32_t volume) {
+    // phase steps are 8.24 fixed point over the wavetable, so everything here is worked out once
+    SoundEffect& effect = soundEffects[sound];
+
+    effect.wavetable = wavetable;
+    effect.samples = SFX_SAMPLE_RATE * lengthMs / 1000;
+    effect.step = startFrequency * 4294967296.0f / SFX_SAMPLE_RATE;
+    effect.sweep = (int32_t)((endFrequency - startFrequency) * 4294967296.0f / SFX_SAMPLE_RATE / effect.samples);
+    effect.volume = volume;
+    effect.decay = volume / effect.samples;
+}
+
+void render_title(Surface& surface) {
     int left = SCREEN_WIDTH / 2 - (TITLE_WIDTH * SPRITE_SIZE) / 2;
     int top = SPRITE_SIZE;
 
@@ -565,7 +1282,7 @@ void render_title() {
                 x = k * SPRITE_SIZE + left;
 
                 if (title[i][j][k]) {
-                    screen.sprite(64, Point(x, y));
+                    surface.sprite(64, Point(x, y));
                 }
             }
         }
@@ -573,6 +1290,523 @@ void render_title() {
     }
 }
 
+void render_frame(Surface& surface) {
+    // clear the screen -- screen is a reference to the frame buffer and can be used to draw all things with the 32blit
+    surface.clear();
+
+    // draw some text at the top of the screen
+    surface.alpha = 255;
+    surface.mask = nullptr;
+    surface.pen = Pen(255, 255, 255);
+
+    if (quality < QUALITY_NO_DECORATION) {
+        surface.blit(background, Rect(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT), Point(0, 0), false);
+
+    }
+
+    if (state == 0) {
+        if (quality >= QUALITY_SIMPLE_TITLE) {
+            surface.text("ArkaBlit", minimal_font, Point(SCREEN_WIDTH / 2, SCREEN_HEIGHT * 1 / 3), true, TextAlign::center_center);
+        }
+        else {
+            render_title(surface);
+        }
+
+        //screen.text("Highscore: " + std::to_string(highscore), minimal_font, Point(SCREEN_WIDTH / 2, SCREEN_HEIGHT * 2 / 3), true, TextAlign::center_center);
+
+        if (suspendData.suspended) {
+            surface.text("A: Start  B: Resume", minimal_font, Point(SCREEN_WIDTH / 2, SCREEN_HEIGHT - SPRITE_SIZE * 1.5), true, TextAlign::center_center);
+        }
+        else {
+            surface.text("Press A to Start", minimal_font, Point(SCREEN_WIDTH / 2, SCREEN_HEIGHT - SPRITE_SIZE * 1.5), true, TextAlign::center_center);
+        }
+    }
+    else if (state == 1) {
+        render_blocks(surface);
+
+        render_powerups(surface);
+
+        render_player(surface);
+
+        if (quality < QUALITY_SLOW_HUD) {
+            render_ball(surface);
+        }
+
+        if (hudCached) {
+            copy_hud_strip(surface, true);
+        }
+        else {
+            render_hud(surface);
+
+            if (quality >= QUALITY_SLOW_HUD) {
+                copy_hud_strip(surface, false);
+            }
+        }
+
+        // the ball can reach into the HUD strip, so with the HUD cached it goes on top rather than into the cache
+        if (quality >= QUALITY_SLOW_HUD) {
+            render_ball(surface);
+        }
+
+        render_multiplier(surface);
+    }
+
+    if (showStats) {
+        render_stats(surface);
+    }
+
+    surface.pen = Pen(0, 0, 0);
+}
+
+void copy_hud_strip(Surface& surface, bool restore) {
+    // only blocks, powerups and the player are drawn before this, and none of them reach above HUD_HEIGHT.
+    // Bands only touch their own rows, so they never share part of the cache
+    int top = surface.clip.y;
+    int bottom = surface.clip.y + surface.clip.h < HUD_HEIGHT ? surface.clip.y + surface.clip.h : HUD_HEIGHT;
+    uint32_t rowBytes = SCREEN_WIDTH * surface.pixel_stride;
+
+    for (int y = top; y < bottom; y++) {
+        if (restore) {
+            memcpy(surface.data + y * rowBytes, hudCache + y * rowBytes, rowBytes);
+        }
+        else {
+            memcpy(hudCache + y * rowBytes, surface.data + y * rowBytes, rowBytes);
+        }
+    }
+}
+
+Surface& render_target() {
+    return hires ? playfield : screen;
+}
+
+void upscale_playfield() {
+    uint32_t start = now_us();
+
+    if (screen.pixel_stride != 3) {
+        // not packed RGB, so leave it to the generic scaler
+        screen.stretch_blit(&playfield, Rect(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT), Rect(0, 0, SCREEN_WIDTH * HIRES_SCALE, SCREEN_HEIGHT * HIRES_SCALE));
+    }
+    else {
+        uint32_t rowBytes = screen.bounds.w * 3;
+
+        for (int y = 0; y < SCREEN_HEIGHT; y++) {
+            const uint8_t* src = playfieldData + y * SCREEN_WIDTH * 3;
+            uint8_t* row = screen.data + y * HIRES_SCALE * rowBytes;
+            uint8_t* dst = row;
+
+            // four pixels in, eight out, shuffled a (little endian) word at a time
+            for (int x = 0; x < SCREEN_WIDTH; x += 4) {
+                uint32_t in[3];
+                uint32_t out[6];
+
+                memcpy(in, src, sizeof(in));
+
+                out[0] = (in[0] & 0xffffff) | (in[0] << 24);
+                out[1] = (in[0] >> 8) | (in[1] << 24);
+                out[2] = ((in[1] >> 8) & 0xff) | ((in[0] >> 24) << 8) | ((in[1] & 0xff) << 16) | (in[1] << 16 & 0xff000000);
+                out[3] = (in[1] >> 16) | ((in[2] & 0xff) << 16) | (in[1] << 8 & 0xff000000);
+                out[4] = (in[1] >> 24) | (in[2] << 8);
+                out[5] = (in[2] >> 24) | (in[2] & 0xffffff00);
+
+                memcpy(dst, out, sizeof(out));
+
+                src += sizeof(in);
+                dst += sizeof(out);
+            }
+
+            // the row below is an exact copy
+            memcpy(row + rowBytes, row, rowBytes);
+        }
+    }
+
+    upscaleUs = us_diff(start, now_us());
+}
+
+void set_hires(bool enabled) {
+    // the upscale writes a full 2x frame, so only use it if the screen really is that size
+    hires = enabled && set_screen_mode(ScreenMode::hires) && screen.bounds.w == SCREEN_WIDTH * HIRES_SCALE && screen.bounds.h == SCREEN_HEIGHT * HIRES_SCALE;
+
+    if (!hires) {
+        set_screen_mode(ScreenMode::lores);
+    }
+
+    // changing mode gives us a fresh screen surface
+    screen.sprites = playfield.sprites;
+
+#ifdef BANDED_RENDERER
+    // the bands point into the old render target
+    render_set_threads(renderBands.size());
+#endif
+}
+
+void governor_update(uint32_t renderUs) {
+    uint32_t time = now();
+    qualityTimeMs[quality] += time - lastGovernorTime;
+    lastGovernorTime = time;
+
+    // update() may have run more than once since the last render
+    frameCostUs = frameUpdateUs + renderUs;
+#ifdef TARGET_32BLIT_HW
+    // mixing is an interrupt on the device, so it steals its time from the frame
+    // (elsewhere it runs on its own audio thread and doesn't)
+    frameCostUs += sfxMixTotalUs.exchange(0, std::memory_order_relaxed);
+#endif
+    frameUpdateUs = 0;
+
+    qualityFrames++;
+
+    // overruns leak away one per good frame, so mostly-over still counts as sustained
+    if (frameCostUs > FRAME_BUDGET_US) {
+        overrunFrames++;
+        headroomFrames = 0;
+    }
+    else {
+        if (overrunFrames > 0) {
+            overrunFrames--;
+        }
+
+        if (frameCostUs < FRAME_BUDGET_US * GOVERNOR_HEADROOM_PERCENT / 100) {
+            headroomFrames++;
+        }
+        else {
+            headroomFrames = 0;
+        }
+    }
+
+    // drop quickly, recover slowly, so a level doesn't flip back and forth
+    if (overrunFrames >= GOVERNOR_OVERRUN_FRAMES && next_quality(1) != quality) {
+        if (qualityRaised && qualityFrames < headroomTarget) {
+            // stepping up didn't hold, wait twice as long before trying again
+            headroomTarget = headroomTarget * 2 < GOVERNOR_MAX_HEADROOM_FRAMES ? headroomTarget * 2 : GOVERNOR_MAX_HEADROOM_FRAMES;
+        }
+        else {
+            headroomTarget = GOVERNOR_HEADROOM_FRAMES;
+        }
+
+        qualityRaised = false;
+        set_quality(next_quality(1));
+    }
+    else if (headroomFrames >= headroomTarget && quality > QUALITY_FULL) {
+        qualityRaised = true;
+        set_quality(next_quality(-1));
+    }
+}
+
+bool quality_applies(int level) {
+    // a level that changes nothing on this screen can't win back any time
+    if (level == QUALITY_SLOW_HUD) {
+        return state == 1;
+    }
+    else if (level == QUALITY_FEWER_EFFECTS) {
+        // fewer effects only saves mixing time, which is only in the frame cost on the device
+#ifdef TARGET_32BLIT_HW
+        return state == 1;
+#else
+        return false;
+#endif
+    }
+    else if (level == QUALITY_SIMPLE_TITLE) {
+        return state == 0;
+    }
+
+    return true;
+}
+
+int next_quality(int step) {
+    for (int level = quality + step; level > QUALITY_FULL && level < QUALITY_COUNT; level += step) {
+        if (quality_applies(level)) {
+            return level;
+        }
+    }
+
+    // nothing further down to drop, or nothing left between here and full quality
+    return step > 0 ? quality : QUALITY_FULL;
+}
+
+void set_quality(int level) {
+    quality = level;
+    qualityChanges++;
+
+    overrunFrames = 0;
+    headroomFrames = 0;
+    qualityFrames = 0;
+
+    // the cached HUD was drawn at the old level, so refresh it straight away
+    hudFrame = 0;
+
+    sfxVoiceLimit.store(quality >= QUALITY_FEWER_EFFECTS ? SFX_REDUCED_VOICES : SFX_VOICES, std::memory_order_relaxed);
+}
+
+#ifdef GOVERNOR_STRESS_TEST
+void stress_wait(uint32_t us) {
+    uint32_t start = now_us();
+
+    while (us_diff(start, now_us()) < us) {
+    }
+}
+
+StressResult stress_run(const char* name, uint32_t frames, uint32_t& time) {
+    StressResult result;
+    result.worstQuality = quality;
+    result.overBudget = 0;
+
+    uint32_t tailUs = 0;
+    result.tailOverBudget = 0;
+
+    result.raises = 0;
+    result.drops = 0;
+    result.skippedLevel = false;
+
+    for (uint32_t i = 0; i < frames; i++) {
+        int lastQuality = quality;
+
+        // drive the game exactly as the firmware would, with a made up clock
+        time += STRESS_FRAME_MS;
+        update(time);
+        render(time);
+
+        if (quality > result.worstQuality) {
+            result.worstQuality = quality;
+        }
+
+        if (quality < lastQuality) {
+            result.raises++;
+        }
+        else if (quality > lastQuality) {
+            result.drops++;
+        }
+
+        if (quality - lastQuality > 1 || lastQuality - quality > 1) {
+            result.skippedLevel = true;
+        }
+
+        if (frameCostUs > FRAME_BUDGET_US) {
+            result.overBudget++;
+        }
+
+        if (i >= frames - STRESS_TAIL_FRAMES) {
+            tailUs += frameCostUs;
+
+            if (frameCostUs > FRAME_BUDGET_US) {
+                result.tailOverBudget++;
+            }
+        }
+    }
+
+    result.tailCostUs = tailUs / STRESS_TAIL_FRAMES;
+
+    printf("stress: %-9s worst q%d, now q%d, %u/%u frames over budget, last %u frames avg %u us (%u over)\n",
+        name, result.worstQuality, quality, result.overBudget, frames, STRESS_TAIL_FRAMES, result.tailCostUs, result.tailOverBudget);
+
+    return result;
+}
+
+void governor_stress_test() {
+    // the load is spread so that each quality level can actually win some of it back
+    printf("stress: budget %u us, load %u us update + %u us background + %u us HUD, heavy %u + %u + %u us\n",
+        FRAME_BUDGET_US, STRESS_UPDATE_US, STRESS_DECORATION_US, STRESS_HUD_US, STRESS_HEAVY_UPDATE_US, STRESS_HEAVY_DECORATION_US, STRESS_HEAVY_HUD_US);
+
+#ifdef BANDED_RENDERER
+    // the loads are per frame, so keep the frame on one thread
+    render_set_threads(1);
+#endif
+
+    state = 1;
+    start_game();
+
+    uint32_t time = now();
+
+    StressResult idle = stress_run("idle", STRESS_IDLE_FRAMES, time);
+
+    // enough to need QUALITY_NO_DECORATION, but no more
+    stressUpdateUs = STRESS_UPDATE_US;
+    stressDecorationUs = STRESS_DECORATION_US;
+    stressHudUs = STRESS_HUD_US;
+
+    StressResult loaded = stress_run("loaded", STRESS_LOAD_FRAMES, time);
+
+    // only fits with the HUD drawn every HUD_REFRESH_FRAMES frames
+    stressUpdateUs = STRESS_HEAVY_UPDATE_US;
+    stressDecorationUs = STRESS_HEAVY_DECORATION_US;
+    stressHudUs = STRESS_HEAVY_HUD_US;
+
+    StressResult heavy = stress_run("heavy", STRESS_HEAVY_FRAMES, time);
+
+    stressUpdateUs = 0;
+    stressDecorationUs = 0;
+    stressHudUs = 0;
+
+    StressResult recovered = stress_run("recovered", STRESS_RECOVER_FRAMES, time);
+
+    printf("stress: %u quality changes, seconds at each level:", qualityChanges);
+    for (int i = 0; i < QUALITY_COUNT; i++) {
+        printf(" %u", qualityTimeMs[i] / 1000);
+    }
+    printf("\n");
+
+    bool steppedDown = idle.worstQuality == QUALITY_FULL && loaded.worstQuality == QUALITY_NO_DECORATION && heavy.worstQuality == QUALITY_SLOW_HUD;
+    bool heldBudget = loaded.tailCostUs < FRAME_BUDGET_US && loaded.tailOverBudget <= STRESS_TAIL_OVERRUNS;
+
+    // the frames that refresh the HUD are still over, the rest have to make up for them
+    bool heavyHeldBudget = heavy.tailCostUs < FRAME_BUDGET_US && heavy.tailOverBudget <= STRESS_TAIL_FRAMES / HUD_REFRESH_FRAMES + STRESS_TAIL_OVERRUNS;
+
+    // back up through every level in turn, without dropping again on the way
+    bool steppedUp = recovered.drops == 0 && !recovered.skippedLevel && recovered.raises == QUALITY_SLOW_HUD && quality == QUALITY_FULL;
+
+    printf("stress: stepped down %s, held budget %s, held heavy budget %s, stepped back up %s\n",
+        steppedDown ? "yes" : "NO", heldBudget ? "yes" : "NO", heavyHeldBudget ? "yes" : "NO", steppedUp ? "yes" : "NO");
+
+    // init() runs on the SDL system thread, so skip the static destructors and atexit handlers exit() would run there
+    fflush(stdout);
+    std::_Exit(steppedDown && heldBudget && heavyHeldBudget && steppedUp ? 0 : 1);
+}
+#endif
+
+#ifdef BANDED_RENDERER
+void render_worker(uint32_t band, uint32_t generation) {
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(renderMutex);
+            renderStart.wait(lock, [&] { return renderQuit || renderGeneration != generation; });
+
+            if (renderQuit) {
+                return;
+            }
+
+            generation = renderGeneration;
+        }
+
+        render_frame(*renderBands.at(band));
+
+        {
+            std::lock_guard<std::mutex> lock(renderMutex);
+            renderPending--;
+        }
+        renderDone.notify_one();
+    }
+}
+
+void render_set_threads(uint32_t threads) {
+    Surface& target = render_target();
+
+    // stop the old workers before their bands go away
+    {
+        std::lock_guard<std::mutex> lock(renderMutex);
+        renderQuit = true;
+    }
+    renderStart.notify_all();
+
+    for (uint32_t i = 0; i < renderWorkers.size(); i++) {
+        renderWorkers.at(i).join();
+    }
+
+    renderWorkers.clear();
+    renderQuit = false;
+
+    for (uint32_t i = 0; i < renderBands.size(); i++) {
+        delete renderBands.at(i);
+    }
+
+    renderBands.clear();
+
+    if (threads < 2) {
+        return;
+    }
+
+    // every band draws the whole frame, clipped to its own rows of the framebuffer
+    for (uint32_t i = 0; i < threads; i++) {
+        int top = target.bounds.h * i / threads;
+        int bottom = target.bounds.h * (i + 1) / threads;
+
+        Surface* band = new Surface(target.data, target.format, target.bounds);
+        band->clip = Rect(0, top, target.bounds.w, bottom - top);
+        band->sprites = target.sprites;
+
+        renderBands.push_back(band);
+    }
+
+    // the render thread draws the first band itself
+    for (uint32_t i = 1; i < threads; i++) {
+        renderWorkers.emplace_back(render_worker, i, renderGeneration);
+    }
+}
+
+void render_banded() {
+    Surface& target = render_target();
+
+    // start each band from the same draw state the screen would have
+    for (uint32_t i = 0; i < renderBands.size(); i++) {
+        renderBands.at(i)->alpha = target.alpha;
+        renderBands.at(i)->mask = target.mask;
+        renderBands.at(i)->pen = target.pen;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(renderMutex);
+        renderPending = renderBands.size() - 1;
+        renderGeneration++;
+    }
+    renderStart.notify_all();
+
+    render_frame(*renderBands.at(0));
+
+    {
+        std::unique_lock<std::mutex> lock(renderMutex);
+        renderDone.wait(lock, [] { return renderPending == 0; });
+    }
+
+    target.alpha = renderBands.at(0)->alpha;
+    target.mask = renderBands.at(0)->mask;
+    target.pen = renderBands.at(0)->pen;
+}
+
+void render_benchmark() {
+    Surface& target = render_target();
+    uint32_t size = target.bounds.w * target.bounds.h * target.pixel_stride;
+    std::vector<uint8_t> reference(size);
+
+    uint32_t maxThreads = std::thread::hardware_concurrency();
+    maxThreads = maxThreads < 1 ? 1 : maxThreads > RENDER_MAX_THREADS ? RENDER_MAX_THREADS : maxThreads;
+
+    // the single threaded frame is what every other thread count has to match
+    render_set_threads(1);
+    render_frame(target);
+    memcpy(reference.data(), target.data, size);
+
+    uint32_t bestThreads = 1;
+    uint32_t bestUs = UINT32_MAX;
+
+    for (uint32_t threads = 1; threads <= maxThreads; threads++) {
+        render_set_threads(threads);
+
+        uint32_t start = now_us();
+
+        for (int i = 0; i < RENDER_BENCHMARK_FRAMES; i++) {
+            if (threads > 1) {
+                render_banded();
+            }
+            else {
+                render_frame(target);
+            }
+        }
+
+        uint32_t frameUs = us_diff(start, now_us()) / RENDER_BENCHMARK_FRAMES;
+        bool identical = memcmp(reference.data(), target.data, size) == 0;
+
+        printf("render: %u thread(s) %u us/frame%s\n", threads, frameUs, identical ? "" : " OUTPUT DIFFERS");
+
+        if (identical && frameUs < bestUs) {
+            bestUs = frameUs;
+            bestThreads = threads;
+        }
+    }
+
+    render_set_threads(bestThreads);
+
+    printf("render: using %u thread(s)\n", bestThreads);
+}
+#endif
+
 ///////////////////////////////////////////////////////////////////////////
 //
 // init()
@@ -580,8 +1814,9 @@ void render_title() {
 // setup your game here
 //
 void init() {
-    set_screen_mode(ScreenMode::lores);
-    screen.sprites = Surface::load(asset_sprites);
+    playfield.sprites = Surface::load(asset_sprites);
+
+    set_hires(false);
 
     player.yPosition = SCREEN_HEIGHT - BORDER * 2;
 
@@ -594,6 +1829,20 @@ void init() {
         // No save file or it failed to load, set up some defaults.
         saveData.highscore = 0;
     }
+
+    if (!read_save(suspendData, SUSPEND_SLOT)) {
+        suspendData.suspended = false;
+    }
+
+    rngState = now() | 1;
+
+    sfx_init();
+
+    lastGovernorTime = now();
+
+#ifdef GOVERNOR_STRESS_TEST
+    governor_stress_test();
+#endif
 }
 
 ///////////////////////////////////////////////////////////////////////////
@@ -604,38 +1853,50 @@ void init() {
 // amount if milliseconds elapsed since the start of your game
 //
 void render(uint32_t time) {
+    uint32_t start = now_us();
 
-    // clear the screen -- screen is a reference to the frame buffer and can be used to draw all things with the 32blit
-    screen.clear();
+    if (state == 1 && quality >= QUALITY_SLOW_HUD) {
+        hudCached = hudFrame % HUD_REFRESH_FRAMES != 0;
+        hudFrame++;
+    }
+    else {
+        hudCached = false;
+        hudFrame = 0;
+    }
 
-    // draw some text at the top of the screen
-    screen.alpha = 255;
-    screen.mask = nullptr;
-    screen.pen = Pen(255, 255, 255);
+    if (showStats) {
+        format_stats();
+    }
 
-    screen.blit(background, Rect(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT), Point(0, 0), false);
+#ifdef GOVERNOR_STRESS_TEST
+    // once per frame rather than once per band
+    stress_wait((quality < QUALITY_NO_DECORATION ? stressDecorationUs : 0) + (state == 1 && !hudCached ? stressHudUs : 0));
+#endif
 
-    if (state == 0) {
-        //screen.text("ArkaBlit", minimal_font, Point(SCREEN_WIDTH / 2, SCREEN_HEIGHT * 1 / 3), true, TextAlign::center_center); // change to custom icon
-        render_title();
+#ifdef BANDED_RENDERER
+    if (renderBenchmarkRequested) {
+        renderBenchmarkRequested = false;
+        render_benchmark();
 
-        //screen.text("Highscore: " + std::to_string(highscore), minimal_font, Point(SCREEN_WIDTH / 2, SCREEN_HEIGHT * 2 / 3), true, TextAlign::center_center);
-
-        screen.text("Press A to Start", minimal_font, Point(SCREEN_WIDTH / 2, SCREEN_HEIGHT - SPRITE_SIZE * 1.5), true, TextAlign::center_center);
+        // don't hand the time the benchmark took to the next update
+        lastTime = now();
     }
-    else if (state == 1) {
-        render_blocks();
 
-        render_powerups();
-
-        render_player();
-
-        render_ball();
+    if (renderBands.size() > 1) {
+        render_banded();
+    }
+    else {
+        render_frame(render_target());
+    }
+#else
+    render_frame(render_target());
+#endif
 
-        render_hud();
+    if (hires) {
+        upscale_playfield();
     }
 
-    screen.pen = Pen(0, 0, 0);
+    governor_update(us_diff(start, now_us()));
 }
 
 ///////////////////////////////////////////////////////////////////////////
@@ -646,16 +1907,67 @@ void render(uint32_t time) {
 // amount if milliseconds elapsed since the start of your game
 //
 void update(uint32_t time) {
-    dt = (time - lastTime) / 1000.0;
-    lastTime = time;
+    uint32_t start = now_us();
+
+#ifdef GOVERNOR_STRESS_TEST
+    stress_wait(stressUpdateUs);
+#endif
+
+    update_game(time);
+
+    frameUpdateUs += us_diff(start, now_us());
+}
+
+void update_game(uint32_t time) {
+    if (time > lastTime) {
+        dt = (time - lastTime) / 1000.0;
+        lastTime = time;
+    }
+    else {
+        // catching up on ticks from before the last benchmark
+        dt = 0;
+    }
+
+    if (buttons.pressed & Button::JOYSTICK) {
+        // clicking the stick toggles the timing overlay
+        showStats = !showStats;
+    }
 
     if (state == 0) {
         if (buttons.pressed & Button::A) {
             state = 1;
             start_game();
         }
+        else if ((buttons.pressed & Button::B) && suspendData.suspended) {
+            state = 1;
+            resume_game();
+        }
+        else if (buttons.pressed & Button::X) {
+            set_hires(!hires);
+        }
     }
     else if (state == 1) {
+        if (buttons.pressed & Button::Y) {
+            // save everything and drop back to the title screen
+            suspend_game();
+            state = 0;
+            return;
+        }
+
+        if (buttons & Button::B) {
+            // step back through the history instead of playing
+            rewind_step();
+            return;
+        }
+
+#ifdef BANDED_RENDERER
+        if ((buttons.pressed & Button::X) && ball.held) {
+            // time the renderer with each thread count and keep the fastest,
+            // only while the ball is held as nothing gets drawn until it's done
+            renderBenchmarkRequested = true;
+        }
+#endif
+
         if ((buttons & Button::DPAD_LEFT) || joystick.x < -MIN_JOYSTICK) {
             player.xPosition -= PADDLE_SPEED * dt;
         }
@@ -675,6 +1987,8 @@ void update(uint32_t time) {
         if (ball.yPosition > SCREEN_HEIGHT + SPRITE_SIZE / 2) {
             player.health -= 1;
             reset_ball();
+
+            sfx_play(SOUND_DEATH, 0);
         }
 
         ball.xPosition += ball.xVelocity * BALL_SPEED * dt;
@@ -687,7 +2001,7 @@ void update(uint32_t time) {
                 ball.held = false;
 
                 // offset xVelocity by a random amount
-                ball.xVelocity = ((rand() % 100) / 100.0) - 0.5;
+                ball.xVelocity = ((next_random() % 100) / 100.0) - 0.5;
 
                 ball.yVelocity = -std::sqrt(1 - (ball.xVelocity * ball.xVelocity));
             }
@@ -708,6 +2022,8 @@ void update(uint32_t time) {
 
                 // reset player combo
                 player.combo = 0;
+
+                sfx_play(SOUND_PADDLE, 0);
             }
         }
 
@@ -741,6 +2057,7 @@ void update(uint32_t time) {
 
             if (powerups.at(0).yPosition > player.yPosition && powerups.at(0).xPosition - SPRITE_SIZE < player.xPosition + player.width && powerups.at(0).xPosition + SPRITE_SIZE > player.xPosition - player.width) {
                 // player collected powerup
+                sfx_play(SOUND_POWERUP, powerups.at(0).id);
 
                 if (powerups.at(0).id == 0) {
                     player.width += 2;
@@ -769,5 +2086,9 @@ void update(uint32_t time) {
                 powerups.erase(powerups.begin());
             }
         }
+
+        if (state == 1) {
+            rewind_capture();
+        }
     }
 }
\ No newline at end of file
@@ -1 +1,17 @@
 #include "32blit.hpp"
+
+#include <atomic>
+
+// timing counters, shown by the stats overlay
+extern uint32_t rewindCaptureUs;
+extern uint32_t rewindCaptureUsMax;
+
+extern std::atomic<uint32_t> sfxMixUs;
+extern std::atomic<uint32_t> sfxMixUsMax;
+
+extern uint32_t upscaleUs;
+
+extern int quality;
+extern uint32_t frameCostUs;
+extern uint32_t qualityTimeMs[];
+extern uint32_t qualityChanges;